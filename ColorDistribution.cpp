@@ -180,10 +180,12 @@ cv::Mat recoObject(const cv::Mat &input,
 }
 
 int closestObjectIndex(const ColorDistribution &h,
-                       const std::vector<std::vector<ColorDistribution>> &all_hists)
+                       const std::vector<std::vector<ColorDistribution>> &all_hists,
+                       float *confidence)
 {
     int best_index = -1;
     float best_dist = FLT_MAX;
+    float second_dist = FLT_MAX;
     for (size_t i = 0; i < all_hists.size(); ++i)
     {
         if (all_hists[i].empty())
@@ -191,31 +193,51 @@ int closestObjectIndex(const ColorDistribution &h,
         float d = minDistance(h, all_hists[i]);
         if (d < best_dist)
         {
+            second_dist = best_dist;
             best_dist = d;
             best_index = static_cast<int>(i);
-            if (best_dist <= 0.f)
+            // la seconde distance est nécessaire pour la confiance
+            if (best_dist <= 0.f && !confidence)
                 break;
         }
+        else if (d < second_dist)
+        {
+            second_dist = d;
+        }
     }
     if (best_index < 0)
     {
         best_index = 0;
     }
+    if (confidence)
+    {
+        if (best_dist == FLT_MAX)
+            *confidence = 0.f;
+        else if (second_dist == FLT_MAX)
+            *confidence = 1.f;
+        else
+        {
+            float sum = best_dist + second_dist;
+            *confidence = (sum > 0.f) ? (second_dist - best_dist) / sum : 0.f;
+        }
+    }
     return best_index;
 }
 
-cv::Mat recoObjectMulti(const cv::Mat &input,
-                        const std::vector<std::vector<ColorDistribution>> &all_col_hists,
-                        const std::vector<cv::Vec3b> &colors,
-                        int bloc,
-                        std::vector<std::vector<int>> &outLabels,
-                        bool doRelax,
-                        int superFactor)
+void labelBlocks(const cv::Mat &input,
+                 const std::vector<std::vector<ColorDistribution>> &all_col_hists,
+                 int bloc,
+                 std::vector<std::vector<int>> &outLabels,
+                 std::vector<std::vector<float>> *outConfidence,
+                 bool doRelax)
 {
     const int rowsBlocs = (input.rows + bloc - 1) / bloc;
     const int colsBlocs = (input.cols + bloc - 1) / bloc;
 
     std::vector<std::vector<int>> labels(rowsBlocs, std::vector<int>(colsBlocs, 0));
+    std::vector<std::vector<float>> conf;
+    if (outConfidence)
+        conf.assign(rowsBlocs, std::vector<float>(colsBlocs, 0.f));
     for (int by = 0; by < rowsBlocs; ++by)
     {
         for (int bx = 0; bx < colsBlocs; ++bx)
@@ -225,13 +247,43 @@ cv::Mat recoObjectMulti(const cv::Mat &input,
             Point p1(x, y);
             Point p2(std::min(x + bloc, input.cols), std::min(y + bloc, input.rows));
             ColorDistribution cd = getColorDistribution(input, p1, p2);
-            int obj_idx = closestObjectIndex(cd, all_col_hists);
+            int obj_idx = closestObjectIndex(cd, all_col_hists, outConfidence ? &conf[by][bx] : nullptr);
             labels[by][bx] = obj_idx;
         }
     }
 
     if (doRelax)
+    {
+        std::vector<std::vector<int>> raw;
+        if (outConfidence)
+            raw = labels;
         relaxLabels(labels, rowsBlocs, colsBlocs, 3);
+        if (outConfidence)
+            for (int by = 0; by < rowsBlocs; ++by)
+                for (int bx = 0; bx < colsBlocs; ++bx)
+                    if (labels[by][bx] != raw[by][bx])
+                        conf[by][bx] = 0.f;
+    }
+
+    outLabels.swap(labels);
+    if (outConfidence)
+        outConfidence->swap(conf);
+}
+
+cv::Mat recoObjectMulti(const cv::Mat &input,
+                        const std::vector<std::vector<ColorDistribution>> &all_col_hists,
+                        const std::vector<cv::Vec3b> &colors,
+                        int bloc,
+                        std::vector<std::vector<int>> &outLabels,
+                        bool doRelax,
+                        int superFactor,
+                        std::vector<std::vector<float>> *outConfidence)
+{
+    const int rowsBlocs = (input.rows + bloc - 1) / bloc;
+    const int colsBlocs = (input.cols + bloc - 1) / bloc;
+
+    std::vector<std::vector<int>> labels;
+    labelBlocks(input, all_col_hists, bloc, labels, outConfidence, doRelax);
 
     if (superFactor < 1)
         superFactor = 1;
@@ -362,4 +414,196 @@ cv::Mat computeMarkers(const std::vector<std::vector<int>> &labels, int bloc, in
     return result;
 }
 
+static int findRoot(std::vector<int> &parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void unite(std::vector<int> &parent, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a == b)
+        return;
+    // la plus petite racine gagne -> ordre de balayage stable
+    if (a < b)
+        parent[b] = a;
+    else
+        parent[a] = b;
+}
+
+// Composantes connexes sur une grille d'ids (CV_32S, id <= 0 ignoré).
+// Chaque cellule couvre cell x cell pixels, tronqués à imageSize ;
+// conf (CV_32F, même taille que la grille) est pondérée par la surface.
+static std::vector<ObjectRegion> connectedRegions(const cv::Mat &ids, const cv::Mat &conf,
+                                                  int cell, cv::Size imageSize)
+{
+    const int rows = ids.rows;
+    const int cols = ids.cols;
+    std::vector<int> parent(rows * cols);
+    for (int i = 0; i < rows * cols; ++i)
+        parent[i] = i;
+
+    for (int y = 0; y < rows; ++y)
+    {
+        const int *row = ids.ptr<int>(y);
+        const int *prev = y > 0 ? ids.ptr<int>(y - 1) : nullptr;
+        for (int x = 0; x < cols; ++x)
+        {
+            int id = row[x];
+            if (id <= 0)
+                continue;
+            if (x > 0 && row[x - 1] == id)
+                unite(parent, y * cols + x, y * cols + x - 1);
+            if (prev && prev[x] == id)
+                unite(parent, y * cols + x, (y - 1) * cols + x);
+        }
+    }
+
+    struct Acc
+    {
+        int id;
+        int x1, y1, x2, y2;
+        double area, sx, sy, sconf;
+    };
+    std::vector<Acc> accs;
+    std::map<int, int> rootToAcc;
+
+    for (int y = 0; y < rows; ++y)
+    {
+        const int *row = ids.ptr<int>(y);
+        const float *crow = conf.ptr<float>(y);
+        int py1 = y * cell;
+        int py2 = std::min(imageSize.height, py1 + cell);
+        if (py2 <= py1)
+            break;
+        for (int x = 0; x < cols; ++x)
+        {
+            if (row[x] <= 0)
+                continue;
+            int px1 = x * cell;
+            int px2 = std::min(imageSize.width, px1 + cell);
+            if (px2 <= px1)
+                break;
+
+            int root = findRoot(parent, y * cols + x);
+            auto it = rootToAcc.find(root);
+            if (it == rootToAcc.end())
+            {
+                it = rootToAcc.insert(std::make_pair(root, (int)accs.size())).first;
+                accs.push_back(Acc{row[x], px1, py1, px2, py2, 0.0, 0.0, 0.0, 0.0});
+            }
+            Acc &a = accs[it->second];
+            double w = (double)(px2 - px1) * (py2 - py1);
+            a.x1 = std::min(a.x1, px1);
+            a.y1 = std::min(a.y1, py1);
+            a.x2 = std::max(a.x2, px2);
+            a.y2 = std::max(a.y2, py2);
+            a.area += w;
+            // moyenne des indices de pixels (convention de cv::moments)
+            a.sx += w * 0.5 * (px1 + px2 - 1);
+            a.sy += w * 0.5 * (py1 + py2 - 1);
+            a.sconf += w * crow[x];
+        }
+    }
+
+    std::vector<ObjectRegion> regions;
+    regions.reserve(accs.size());
+    for (const auto &a : accs)
+    {
+        ObjectRegion r;
+        r.id = a.id;
+        r.box = cv::Rect(a.x1, a.y1, a.x2 - a.x1, a.y2 - a.y1);
+        r.area = (int)a.area;
+        r.centroid = cv::Point2f((float)(a.sx / a.area), (float)(a.sy / a.area));
+        r.confidence = (float)(a.sconf / a.area);
+        regions.push_back(r);
+    }
+    return regions;
+}
+
+std::vector<ObjectRegion> extractRegions(const std::vector<std::vector<int>> &labels,
+                                         const std::vector<std::vector<float>> &confidence,
+                                         int bloc,
+                                         cv::Size imageSize)
+{
+    if (labels.empty() || labels[0].empty())
+        return std::vector<ObjectRegion>();
+    const int rows = labels.size();
+    const int cols = labels[0].size();
+
+    cv::Mat ids(rows, cols, CV_32S);
+    cv::Mat conf(rows, cols, CV_32F, cv::Scalar(1.f));
+    for (int y = 0; y < rows; ++y)
+        for (int x = 0; x < cols; ++x)
+        {
+            ids.at<int>(y, x) = labels[y][x];
+            if (y < (int)confidence.size() && x < (int)confidence[y].size())
+                conf.at<float>(y, x) = confidence[y][x];
+        }
+    return connectedRegions(ids, conf, bloc, imageSize);
+}
+
+std::vector<ObjectRegion> extractRegionsFromMarkers(const cv::Mat &markers,
+                                                    const std::vector<std::vector<float>> &confidence,
+                                                    int bloc,
+                                                    cv::Size imageSize)
+{
+    CV_Assert(markers.type() == CV_32S);
+    // shift de 1 : 0 (indéfini) et -1 (frontière) deviennent <= 0 -> ignorés
+    cv::Mat ids = markers - 1;
+    // watershed met -1 sur tout le bord de l'image : on y recopie le voisin
+    // intérieur pour que les régions touchent les bords comme sur la grille de blocs
+    if (ids.rows >= 3 && ids.cols >= 3)
+    {
+        const int last_r = ids.rows - 1, last_c = ids.cols - 1;
+        for (int x = 0; x < ids.cols; ++x)
+        {
+            if (ids.at<int>(0, x) == -2)
+                ids.at<int>(0, x) = ids.at<int>(1, x);
+            if (ids.at<int>(last_r, x) == -2)
+                ids.at<int>(last_r, x) = ids.at<int>(last_r - 1, x);
+        }
+        for (int y = 0; y < ids.rows; ++y)
+        {
+            if (ids.at<int>(y, 0) == -2)
+                ids.at<int>(y, 0) = ids.at<int>(y, 1);
+            if (ids.at<int>(y, last_c) == -2)
+                ids.at<int>(y, last_c) = ids.at<int>(y, last_c - 1);
+        }
+    }
+    cv::Mat conf(markers.size(), CV_32F, cv::Scalar(1.f));
+    for (int y = 0; y < markers.rows; ++y)
+    {
+        int by = y / bloc;
+        if (by >= (int)confidence.size())
+            break;
+        float *crow = conf.ptr<float>(y);
+        for (int x = 0; x < markers.cols; ++x)
+        {
+            int bx = x / bloc;
+            if (bx >= (int)confidence[by].size())
+                break;
+            crow[x] = confidence[by][bx];
+        }
+    }
+    return connectedRegions(ids, conf, 1, imageSize);
+}
 
+void writeRegions(std::ostream &os, int frame, const std::vector<ObjectRegion> &regions)
+{
+    os << "frame " << frame << ' ' << regions.size() << '\n';
+    for (const auto &r : regions)
+    {
+        os << r.id << ' '
+           << r.box.x << ' ' << r.box.y << ' ' << r.box.width << ' ' << r.box.height << ' '
+           << r.area << ' ' << r.centroid.x << ' ' << r.centroid.y << ' '
+           << r.confidence << '\n';
+    }
+    os.flush();
+}
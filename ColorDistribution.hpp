@@ -1,6 +1,7 @@
 #pragma once
 #include <opencv2/opencv.hpp>
 #include <vector>
+#include <ostream>
 
 using namespace cv;
 
@@ -35,8 +36,22 @@ cv::Mat recoObject(const cv::Mat &input,
                    const std::vector<cv::Vec3b> &colors,
                    const int bloc);
 
+// Retourne l'index de l'objet le plus proche de h.
+// Si confidence est fourni, y écrit la marge entre la meilleure et la seconde
+// distance, normalisée dans [0, 1] (1 = aucune ambiguïté).
 int closestObjectIndex(const ColorDistribution& h,
-                       const std::vector<std::vector<ColorDistribution>>& all_hists);
+                       const std::vector<std::vector<ColorDistribution>>& all_hists,
+                       float *confidence = nullptr);
+
+// Calcule la grille des labels par bloc (sans aucun rendu).
+// outConfidence (optionnel) reçoit la confiance de chaque bloc ; un bloc
+// dont le label a été changé par la relaxation a une confiance nulle.
+void labelBlocks(const cv::Mat &input,
+                 const std::vector<std::vector<ColorDistribution>> &all_col_hists,
+                 int bloc,
+                 std::vector<std::vector<int>> &outLabels,
+                 std::vector<std::vector<float>> *outConfidence = nullptr,
+                 bool doRelax = true);
 
 cv::Mat recoObjectMulti(const cv::Mat &input,
                         const std::vector<std::vector<ColorDistribution>> &all_col_hists,
@@ -44,7 +59,8 @@ cv::Mat recoObjectMulti(const cv::Mat &input,
                         int bloc,
                         std::vector<std::vector<int>> &outLabels,
                         bool doRelax = true,
-                        int superFactor = 4);
+                        int superFactor = 4,
+                        std::vector<std::vector<float>> *outConfidence = nullptr);
 
 void addDistributionIfFar(std::vector<ColorDistribution> &hists,
                           const ColorDistribution &newHist,
@@ -54,3 +70,35 @@ void relaxLabels(std::vector<std::vector<int>>& labels, int nbRows, int nbCols,
 
 Mat computeMarkers(const std::vector<std::vector<int>> &labels, int bloc, int superFactor);
 
+
+// Région connexe d'un même objet
+struct ObjectRegion
+{
+    int id;              // index de l'objet (1..n, 0 = fond)
+    cv::Rect box;        // boîte englobante en pixels
+    int area;            // surface en pixels
+    cv::Point2f centroid;
+    float confidence;    // confiance moyenne sur la région
+};
+
+// Composantes connexes (union-find, 4-connexité) directement sur la grille de blocs.
+// Les blocs du fond (label 0) sont ignorés.
+std::vector<ObjectRegion> extractRegions(const std::vector<std::vector<int>> &labels,
+                                         const std::vector<std::vector<float>> &confidence,
+                                         int bloc,
+                                         cv::Size imageSize);
+
+// Raffinement pleine résolution : composantes connexes sur les marqueurs du watershed
+// (label + 1, -1 sur les frontières). Les frontières intérieures sont ignorées ; le bord
+// de l'image (mis à -1 par watershed) reprend le label du pixel voisin, pour que les
+// régions touchent les bords comme avec extractRegions. La confiance vient du bloc
+// sous chaque pixel.
+std::vector<ObjectRegion> extractRegionsFromMarkers(const cv::Mat &markers,
+                                                    const std::vector<std::vector<float>> &confidence,
+                                                    int bloc,
+                                                    cv::Size imageSize);
+
+// Écrit la liste des régions d'une frame : une ligne d'en-tête "frame N count",
+// puis count lignes "id x y w h area cx cy confidence" (count peut valoir 0).
+// Les centroïdes sont en coordonnées d'indices de pixels.
+void writeRegions(std::ostream &os, int frame, const std::vector<ObjectRegion> &regions);
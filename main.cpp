@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <iostream>
+#include <fstream>
 #include <algorithm>
 #include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc.hpp>
@@ -34,11 +35,34 @@ int main(int argc, char **argv)
   int small_bloc = 8;
   bool useRelaxDefault = true;
   int superFactorDefault = 2;
+  bool refine = true;
+  int frame = 0;
+
+  // Flux optionnel des régions détectées (fichier ou pipe, "-" = sortie standard)
+  ofstream regions_file;
+  ostream *regions_out = nullptr;
+  if (argc > 1)
+  {
+    if (string(argv[1]) == "-")
+      regions_out = &cout;
+    else
+    {
+      regions_file.open(argv[1]);
+      if (!regions_file)
+      {
+        cout << "Couldn't open regions output " << argv[1] << endl;
+        return 1;
+      }
+      regions_out = &regions_file;
+    }
+  }
+  // si les régions sortent sur stdout, les messages passent sur stderr
+  ostream &msg = (regions_out == &cout) ? cerr : cout;
 
   // Ouvre la camera
   if (!pCap.isOpened())
   {
-    cout << "Couldn't open image / camera ";
+    msg << "Couldn't open image / camera ";
     return 1;
   }
 
@@ -71,18 +95,19 @@ int main(int argc, char **argv)
 
   int current_object = -1;
 
-  cout << "\n=== Commandes disponibles ===" << endl;
-  cout << " b : apprendre le fond" << endl;
-  cout << " n : créer un nouvel objet" << endl;
-  cout << " a : ajouter un échantillon à l'objet courant" << endl;
-  cout << " r : activer/désactiver la reconnaissance" << endl;
-  cout << " v : comparer gauche/droite (test distance)" << endl;
-  cout << " f : geler/dégeler la caméra" << endl;
-  cout << " g : activer/désactiver le lissage (relaxation)" << endl;
-  cout << " +/- : augmenter/diminuer DIST_THRESHOLD (filtre doublons)" << endl;
-  cout << " s/S : augmenter/diminuer superFactor (grouping)" << endl;
-  cout << " q / ESC : quitter" << endl;
-  cout << "=============================\n"
+  msg << "\n=== Commandes disponibles ===" << endl;
+  msg << " b : apprendre le fond" << endl;
+  msg << " n : créer un nouvel objet" << endl;
+  msg << " a : ajouter un échantillon à l'objet courant" << endl;
+  msg << " r : activer/désactiver la reconnaissance" << endl;
+  msg << " v : comparer gauche/droite (test distance)" << endl;
+  msg << " f : geler/dégeler la caméra" << endl;
+  msg << " g : activer/désactiver le lissage (relaxation)" << endl;
+  msg << " +/- : augmenter/diminuer DIST_THRESHOLD (filtre doublons)" << endl;
+  msg << " s/S : augmenter/diminuer superFactor (grouping)" << endl;
+  msg << " w : activer/désactiver le raffinement pleine résolution (watershed)" << endl;
+  msg << " q / ESC : quitter" << endl;
+  msg << "=============================\n"
        << endl;
 
   while (true)
@@ -111,27 +136,27 @@ int main(int argc, char **argv)
           ColorDistribution cd = getColorDistribution(img_input, Point(x, y), Point(x + bbloc, y + bbloc));
           addDistributionIfFar(all_col_hists[0], cd, DIST_THRESHOLD);
         }
-      cout << "Fond appris (" << all_col_hists[0].size() << " distributions uniques)." << endl;
+      msg << "Fond appris (" << all_col_hists[0].size() << " distributions uniques)." << endl;
     }
 
     if (c == 'n')
     {
       all_col_hists.push_back(vector<ColorDistribution>());
       current_object = (int)all_col_hists.size() - 1;
-      cout << "Nouvel objet créé : index " << current_object << endl;
+      msg << "Nouvel objet créé : index " << current_object << endl;
     }
 
     if (c == 'a')
     {
       if (current_object < 1)
       {
-        cout << "Erreur : crée d'abord un objet avec 'n' avant d'ajouter des échantillons." << endl;
+        msg << "Erreur : crée d'abord un objet avec 'n' avant d'ajouter des échantillons." << endl;
       }
       else
       {
         ColorDistribution cd = getColorDistribution(img_input, pt1, pt2);
         addDistributionIfFar(all_col_hists[current_object], cd, DIST_THRESHOLD);
-        cout << "Échantillon ajouté à l'objet " << current_object
+        msg << "Échantillon ajouté à l'objet " << current_object
              << " (" << all_col_hists[current_object].size() << " distributions uniques)." << endl;
       }
     }
@@ -139,42 +164,48 @@ int main(int argc, char **argv)
     if (c == 'r')
     {
       reco = !reco;
-      cout << "Reconnaissance : " << (reco ? "ON" : "OFF") << endl;
+      msg << "Reconnaissance : " << (reco ? "ON" : "OFF") << endl;
     }
 
     if (c == 'g')
     {
       show_relaxed = !show_relaxed;
-      cout << "Mode lissage : " << (show_relaxed ? "activé" : "désactivé") << endl;
+      msg << "Mode lissage : " << (show_relaxed ? "activé" : "désactivé") << endl;
     }
 
     if (c == '+' || c == '=')
     {
       DIST_THRESHOLD = std::min(1.f, DIST_THRESHOLD + 0.005f);
-      cout << "DIST_THRESHOLD = " << DIST_THRESHOLD << endl;
+      msg << "DIST_THRESHOLD = " << DIST_THRESHOLD << endl;
     }
     if (c == '-' || c == '_')
     {
       DIST_THRESHOLD = std::max(0.f, DIST_THRESHOLD - 0.005f);
-      cout << "DIST_THRESHOLD = " << DIST_THRESHOLD << endl;
+      msg << "DIST_THRESHOLD = " << DIST_THRESHOLD << endl;
     }
 
     if (c == 's')
     {
       superFactorDefault = std::min(8, superFactorDefault + 1);
-      cout << "superFactor = " << superFactorDefault << endl;
+      msg << "superFactor = " << superFactorDefault << endl;
     }
     if (c == 'S')
     {
       superFactorDefault = std::max(1, superFactorDefault - 1);
-      cout << "superFactor = " << superFactorDefault << endl;
+      msg << "superFactor = " << superFactorDefault << endl;
+    }
+
+    if (c == 'w')
+    {
+      refine = !refine;
+      msg << "Raffinement : " << (refine ? "activé" : "désactivé (boîtes seules)") << endl;
     }
 
     if (c == 'v')
     {
       ColorDistribution left = getColorDistribution(img_input, Point(0, 0), Point(width / 2, height));
       ColorDistribution right = getColorDistribution(img_input, Point(width / 2, 0), Point(width, height));
-      cout << "Distance gauche/droite = " << left.distance(right) << endl;
+      msg << "Distance gauche/droite = " << left.distance(right) << endl;
     }
 
     Mat output = img_input.clone();
@@ -187,32 +218,54 @@ int main(int argc, char **argv)
       int sf = show_relaxed ? superFactorDefault : 1;
 
       std::vector<std::vector<int>> labels;
-      Mat reco_img = recoObjectMulti(img_input, all_col_hists, colors, small_bloc, labels, show_relaxed, sf);
+      std::vector<std::vector<float>> confidence;
+      labelBlocks(img_input, all_col_hists, small_bloc, labels, &confidence, show_relaxed);
 
-      Mat markers = computeMarkers(labels, small_bloc, sf);
+      std::vector<ObjectRegion> regions;
+      if (refine)
+      {
+        Mat markers = computeMarkers(labels, small_bloc, sf);
 
-      Mat img_for_ws;
-      img_input.copyTo(img_for_ws);
-      cv::watershed(img_for_ws, markers);
+        Mat img_for_ws;
+        img_input.copyTo(img_for_ws);
+        cv::watershed(img_for_ws, markers);
 
-      Mat final = Mat::zeros(img_input.size(), CV_8UC3);
-      for (int y = 0; y < markers.rows; ++y)
-      {
-        for (int x = 0; x < markers.cols; ++x)
+        Mat final = Mat::zeros(img_input.size(), CV_8UC3);
+        for (int y = 0; y < markers.rows; ++y)
         {
-          int idx = markers.at<int>(y, x);
-
-          // shift de 1 comme 0 est undefined dans watershed !!
-          if (idx > 0)
+          for (int x = 0; x < markers.cols; ++x)
           {
-            int original_idx = idx - 1;
-            if (original_idx >= 0 && original_idx < (int)colors.size())
-              final.at<Vec3b>(y, x) = colors[original_idx];
+            int idx = markers.at<int>(y, x);
+
+            // shift de 1 comme 0 est undefined dans watershed !!
+            if (idx > 0)
+            {
+              int original_idx = idx - 1;
+              if (original_idx >= 0 && original_idx < (int)colors.size())
+                final.at<Vec3b>(y, x) = colors[original_idx];
+            }
           }
         }
+
+        addWeighted(final, 0.7, img_input, 0.3, 0.0, output);
+        regions = extractRegionsFromMarkers(markers, confidence, small_bloc, img_input.size());
+      }
+      else
+      {
+        // boîtes seules : composantes connexes sur la grille de blocs, sans rendu
+        regions = extractRegions(labels, confidence, small_bloc, img_input.size());
+      }
+
+      for (const auto &r : regions)
+      {
+        // saute la couleur 0 (fond) quand on boucle sur la palette
+        Vec3b col = colors[1 + (r.id - 1) % ((int)colors.size() - 1)];
+        rectangle(output, r.box, Scalar(col), 2);
+        circle(output, Point(cvRound(r.centroid.x), cvRound(r.centroid.y)), 3, Scalar(col), FILLED);
       }
 
-      addWeighted(final, 0.7, img_input, 0.3, 0.0, output);
+      if (regions_out)
+        writeRegions(*regions_out, frame, regions);
     }
     else
     {
@@ -220,15 +273,17 @@ int main(int argc, char **argv)
     }
 
     vector<string> lines;
-    lines.push_back("b:fond  n:newObj  a:addSample  r:reco  g:relax  +/-:thresh  s/S:superFactor");
+    lines.push_back("b:fond  n:newObj  a:addSample  r:reco  g:relax  +/-:thresh  s/S:superFactor  w:refine");
     lines.push_back(string("Recon:") + (reco ? "ON " : "OFF ") +
                     "  Lissage:" + (show_relaxed ? "ON " : "OFF ") +
-                    "  Thresh:" + to_string(DIST_THRESHOLD));
+                    "  Thresh:" + to_string(DIST_THRESHOLD) +
+                    "  Raffinement:" + (refine ? "ON" : "OFF"));
     lines.push_back(string("NbObjs:") + to_string((int)all_col_hists.size() - 1) +
                     "  Current:" + to_string(current_object));
     putOverlay(output, lines);
 
     imshow("input", output);
+    frame++;
   }
 
   return 0;